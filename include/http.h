@@ -6,7 +6,7 @@
 #include "server_config.h"
 
 void prepare_http_redirect(client_t *client, const char *location_url);
-void prepare_http_response(client_t *client, unsigned int status_code, char *status_msg, char *content_t, FILE *file, off_t file_size);
+void prepare_http_response(client_t *client, unsigned int status_code, char *status_msg, char *content_t, FILE *file, off_t file_size, const char *links, int early_hints);
 int send_header_chunk(client_t *client);
 int send_file_chunk(client_t *client);
 void handle_http_request(client_t *client, const char *request);
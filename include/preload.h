@@ -0,0 +1,10 @@
+#ifndef PRELOAD_H
+#define PRELOAD_H
+
+#include <stdio.h>
+#include <sys/types.h>
+
+int load_preload_config(const char *config_path);
+const char *get_preload_links(const char *path, FILE *fp, off_t file_size);
+
+#endif
@@ -11,6 +11,15 @@
 #define BASE_CONFIG "config"
 #define FILE_404 "config/404.html"
 #define FILE_405 "config/405.html"
+#define PRELOAD_CONFIG "config/preload.conf"
+
+// Early Hints / Link preload
+#define PRELOAD_ENABLED 1           // set 0 to disable 103 Early Hints and Link headers
+#define PRELOAD_CACHE_SIZE 32       // number of scanned HTML pages kept in memory
+#define PRELOAD_MAX_OVERRIDES 32    // number of pages configurable in PRELOAD_CONFIG
+#define PRELOAD_MAX_LINKS 8         // maximum preload entries per page
+#define PRELOAD_LINKS_SIZE 1024     // maximum length of the Link header value
+#define PRELOAD_SCAN_LIMIT 65536    // only the first bytes of a page are scanned
 
 typedef enum {
     READING_REQ,
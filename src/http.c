@@ -6,6 +6,7 @@
 #include <inttypes.h>
 #include "http.h"
 #include "file_utils.h"
+#include "preload.h"
 
 void prepare_http_redirect(client_t *client, const char *location_url){
     char header[1024];
@@ -28,7 +29,7 @@ void prepare_http_redirect(client_t *client, const char *location_url){
     client->state = SENDING_HEADER;
 }
 
-void prepare_http_response(client_t *client, unsigned int status_code, char *status_msg, char *content_t, FILE *file, off_t file_size){
+void prepare_http_response(client_t *client, unsigned int status_code, char *status_msg, char *content_t, FILE *file, off_t file_size, const char *links, int early_hints){
 
     // Prepare file
     client->file = file;
@@ -38,14 +39,26 @@ void prepare_http_response(client_t *client, unsigned int status_code, char *sta
     client->file_buffer_offset = 0;
 
     // Prepare header
-    char header[1024];
-    int header_len = snprintf(header, sizeof(header), 
+    // With `links`, a 103 Early Hints interim response goes out ahead of the final header
+    // so the browser can start fetching the assets while the body is still being streamed
+    char header[1024 + 2*PRELOAD_LINKS_SIZE];
+    int header_len = 0;
+    if(links && early_hints){
+        header_len += snprintf(header, sizeof(header),
+                "HTTP/1.1 103 Early Hints\r\n"
+                "Link: %s\r\n"
+                "\r\n"
+                , links);
+    }
+    header_len += snprintf(header + header_len, sizeof(header) - header_len,
             "HTTP/1.1 %u %s\r\n"
             "Content-Type: %s\r\n"
             "Content-Length: %" PRIuMAX "\r\n"
+            "%s%s%s"
             "Connection: close\r\n"
             "\r\n"
-            , status_code, status_msg, content_t, (uintmax_t)file_size);
+            , status_code, status_msg, content_t, (uintmax_t)file_size
+            , links ? "Link: " : "", links ? links : "", links ? "\r\n" : "");
     client->header = malloc(header_len+1);
     memcpy(client->header, header, header_len);
     client->header_len = header_len;
@@ -146,6 +159,7 @@ void handle_http_request(client_t *client, const char *request){
 
     unsigned int http_status;
     char status_msg[64], content_t[64];
+    const char *links = NULL;
     FILE *file = fopen(full_path, "rb");
     off_t f_size;
     if(strcmp(method, "GET") == 0){
@@ -170,6 +184,11 @@ void handle_http_request(client_t *client, const char *request){
             strcpy(status_msg, "OK");
             strcpy(content_t, get_content_type(path));
 
+            // Preload the page's stylesheets and scripts
+            if(PRELOAD_ENABLED && strcmp(content_t, "text/html") == 0){
+                links = get_preload_links(path, file, f_size);
+            }
+
         }else{
             // 404 - Page Not Found
 
@@ -208,7 +227,8 @@ void handle_http_request(client_t *client, const char *request){
         strcpy(content_t, get_content_type(FILE_405));
     }
     printf("Method : %s\nPath: %s [%s]\nVersion: %s\n", method, path, file_state, version);
-    prepare_http_response(client, http_status, status_msg, content_t, file, f_size);
+    // Interim (1xx) responses are not defined for HTTP/1.0 clients
+    prepare_http_response(client, http_status, status_msg, content_t, file, f_size, links, strcmp(version, "HTTP/1.1") == 0);
     free(req);
 }
 
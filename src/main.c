@@ -13,6 +13,7 @@
 #include "client.h"
 #include "http.h"
 #include "network.h"
+#include "preload.h"
 
 
 int main(int argc, char **argv){
@@ -24,6 +25,12 @@ int main(int argc, char **argv){
     }
     const char *serv_ip = argv[1];
     unsigned short serv_port = atoi(argv[2]);
+
+    // Loading preload overrides
+    int n_overrides = load_preload_config(PRELOAD_CONFIG);
+    if(n_overrides > 0){
+        printf("Loaded %d preload override(s) from %s\n", n_overrides, PRELOAD_CONFIG);
+    }
     
     // Establishing server socket
     int serv_sock = socket(AF_INET, SOCK_STREAM, 0);
@@ -0,0 +1,308 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+#include <errno.h>
+#include <time.h>
+#include <sys/stat.h>
+#include "server_config.h"
+#include "preload.h"
+
+typedef struct {
+    char path[256];
+    time_t mtime;
+    off_t size;
+    char links[PRELOAD_LINKS_SIZE];
+}preload_entry_t;
+
+typedef struct {
+    char path[256];
+    int disabled;
+    char links[PRELOAD_LINKS_SIZE];
+}preload_override_t;
+
+// Scanned pages, validated by mtime and size on every lookup
+static preload_entry_t preload_cache[PRELOAD_CACHE_SIZE];
+static unsigned int n_cache = 0;
+static unsigned int next_evict = 0;
+
+// Per-page overrides loaded from PRELOAD_CONFIG
+static preload_override_t overrides[PRELOAD_MAX_OVERRIDES];
+static unsigned int n_overrides = 0;
+
+/* Resolves `ref` against the directory of the request `path` into `out`.
+ * Only same-origin references are accepted.
+ * RETURN VALUES: 0 (resolved), -1 (skipped) */
+static int resolve_url(const char *path, const char *ref, char *out, size_t out_size){
+    char url[256];
+    size_t ref_len = strcspn(ref, "#"); // fragments are never sent to the server
+
+    if(ref_len == 0 || ref_len >= sizeof(url)) return -1;
+    memcpy(url, ref, ref_len);
+    url[ref_len] = 0;
+
+    // Skip external (`//host/...`, `https://...`) and non-http (`data:`, `javascript:`) references
+    if(strncmp(url, "//", 2) == 0) return -1;
+    const char *colon = strchr(url, ':');
+    const char *slash = strchr(url, '/');
+    if(colon && (!slash || colon < slash)) return -1;
+
+    // Skip anything that would break the Link header
+    for(const char *c = url; *c; c++){
+        if(*c <= ' ' || *c == 0x7f || *c == '<' || *c == '>' || *c == '"') return -1;
+    }
+
+    int n;
+    if(url[0] == '/'){
+        n = snprintf(out, out_size, "%s", url);
+    }else{
+        const char *dir_end = strrchr(path, '/');
+        int dir_len = dir_end ? (int)(dir_end - path) + 1 : 0;
+        n = snprintf(out, out_size, "%.*s%s", dir_len, path, url);
+    }
+    if(n < 0 || (size_t)n >= out_size) return -1;
+    return 0;
+}
+
+/* Appends `<url>; rel=preload; as=<as>` to the comma separated `links`.
+ * RETURN VALUES: 0 (appended or duplicate), -1 (no room) */
+static int append_link(char *links, size_t links_size, const char *url, const char *as){
+    char entry[512];
+    int entry_len = snprintf(entry, sizeof(entry), "<%s>; rel=preload; as=%s%s",
+            url, as, strcmp(as, "font") == 0 ? "; crossorigin" : "");
+    if(entry_len < 0 || (size_t)entry_len >= sizeof(entry)) return -1;
+
+    // Each entry starts with '<', which cannot appear inside a resolved url
+    unsigned int n_links = 0;
+    for(const char *c = links; *c; c++){
+        if(*c == '<') n_links++;
+    }
+    if(n_links >= PRELOAD_MAX_LINKS) return -1;
+
+    // Skip duplicates (e.g. the same script included twice)
+    size_t url_len = strlen(url);
+    for(const char *c = strchr(links, '<'); c; c = strchr(c+1, '<')){
+        if(strncmp(c+1, url, url_len) == 0 && c[url_len+1] == '>') return 0;
+    }
+
+    size_t len = strlen(links);
+    size_t need = len + (len ? 2 : 0) + entry_len;
+    if(need >= links_size) return -1;
+    if(len){
+        strcpy(links + len, ", ");
+        len += 2;
+    }
+    strcpy(links + len, entry);
+    return 0;
+}
+
+/* Copies the value of attribute `name` of the tag body `tag` (text between '<' and '>') into `out`.
+ * RETURN VALUES: 0 (found), -1 (not found) */
+static int get_attr(const char *tag, size_t tag_len, const char *name, char *out, size_t out_size){
+    size_t name_len = strlen(name);
+    size_t i = 0;
+
+    // Skip the tag name
+    while(i < tag_len && !isspace((unsigned char)tag[i])) i++;
+
+    while(i < tag_len){
+        while(i < tag_len && (isspace((unsigned char)tag[i]) || tag[i] == '/')) i++;
+
+        size_t attr_start = i;
+        while(i < tag_len && !isspace((unsigned char)tag[i]) && tag[i] != '=' && tag[i] != '/') i++;
+        size_t attr_len = i - attr_start;
+
+        while(i < tag_len && isspace((unsigned char)tag[i])) i++;
+
+        const char *value = "";
+        size_t value_len = 0;
+        if(i < tag_len && tag[i] == '='){
+            i++;
+            while(i < tag_len && isspace((unsigned char)tag[i])) i++;
+            if(i < tag_len && (tag[i] == '"' || tag[i] == '\'')){
+                char quote = tag[i++];
+                value = tag + i;
+                while(i < tag_len && tag[i] != quote) i++;
+                value_len = (tag + i) - value;
+                if(i < tag_len) i++; // closing quote
+            }else{
+                value = tag + i;
+                while(i < tag_len && !isspace((unsigned char)tag[i])) i++;
+                value_len = (tag + i) - value;
+            }
+        }else if(attr_len == 0){
+            i++; // stray character, avoid looping forever
+            continue;
+        }
+
+        if(attr_len == name_len && strncasecmp(tag + attr_start, name, name_len) == 0){
+            if(value_len >= out_size) return -1;
+            memcpy(out, value, value_len);
+            out[value_len] = 0;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+/* Collects stylesheets and classic scripts referenced by `html` into `links` */
+static void scan_html(const char *path, const char *html, char *links, size_t links_size){
+    char value[256], url[256];
+    const char *p = html;
+
+    links[0] = 0;
+    while((p = strchr(p, '<')) != NULL){
+        // Skip comments, commented out assets are never requested
+        if(strncmp(p, "<!--", 4) == 0){
+            p = strstr(p + 4, "-->");
+            if(!p) break;
+            continue;
+        }
+
+        const char *end = strchr(p, '>');
+        if(!end) break;
+        const char *tag = p + 1;
+        size_t tag_len = end - tag;
+        p = end + 1;
+
+        if(strncasecmp(tag, "link", 4) == 0 && isspace((unsigned char)tag[4])){
+            // rel="stylesheet" (but not "alternate stylesheet")
+            if(get_attr(tag, tag_len, "rel", value, sizeof(value)) != 0) continue;
+            for(char *c = value; *c; c++) *c = tolower((unsigned char)*c);
+            if(!strstr(value, "stylesheet") || strstr(value, "alternate")) continue;
+
+            if(get_attr(tag, tag_len, "href", value, sizeof(value)) != 0) continue;
+            if(resolve_url(path, value, url, sizeof(url)) != 0) continue;
+            if(append_link(links, links_size, url, "style") != 0) break;
+
+        }else if(strncasecmp(tag, "script", 6) == 0 && isspace((unsigned char)tag[6])){
+            // Module scripts need rel=modulepreload, leave them to the browser
+            if(get_attr(tag, tag_len, "type", value, sizeof(value)) == 0 && strcasecmp(value, "module") == 0) continue;
+
+            if(get_attr(tag, tag_len, "src", value, sizeof(value)) != 0) continue;
+            if(resolve_url(path, value, url, sizeof(url)) != 0) continue;
+            if(append_link(links, links_size, url, "script") != 0) break;
+        }
+    }
+}
+
+static preload_override_t *find_override(const char *path){
+    for(unsigned int i = 0; i < n_overrides; i++){
+        if(strcmp(overrides[i].path, path) == 0){
+            return &overrides[i];
+        }
+    }
+    return NULL;
+}
+
+/*
+# <request path> <asset url> <as>
+/index.html /fonts/main.woff2 font
+# `-` disables the hints for the page
+/about.html -
+*/
+// RETURN VALUES: number of overrides loaded, -1 (error)
+int load_preload_config(const char *config_path){
+    FILE *fp = fopen(config_path, "r");
+    if(!fp){
+        if(errno == ENOENT) return 0; // the config file is optional
+        perror("Cannot open the preload config");
+        return -1;
+    }
+
+    char line[1024], path[256], asset[256], as[32], url[256];
+    unsigned int line_no = 0;
+    while(fgets(line, sizeof(line), fp)){
+        line_no++;
+        char *comment = strchr(line, '#');
+        if(comment) *comment = 0;
+
+        int n = sscanf(line, "%255s %255s %31s", path, asset, as);
+        if(n <= 0) continue; // blank line
+
+        if(n < 2 || path[0] != '/' || (strcmp(asset, "-") != 0 && n < 3)){
+            fprintf(stderr, "%s:%u: expected `<path> <asset> <as>` or `<path> -`\n", config_path, line_no);
+            continue;
+        }
+
+        preload_override_t *override = find_override(path);
+        if(!override){
+            if(n_overrides >= PRELOAD_MAX_OVERRIDES){
+                fprintf(stderr, "%s:%u: too many pages, max %d\n", config_path, line_no, PRELOAD_MAX_OVERRIDES);
+                continue;
+            }
+            override = &overrides[n_overrides++];
+            strcpy(override->path, path);
+            override->disabled = 0;
+            override->links[0] = 0;
+        }
+
+        if(strcmp(asset, "-") == 0){
+            override->disabled = 1;
+            continue;
+        }
+        if(resolve_url(path, asset, url, sizeof(url)) != 0 ||
+                append_link(override->links, sizeof(override->links), url, as) != 0){
+            fprintf(stderr, "%s:%u: cannot preload `%s`\n", config_path, line_no, asset);
+        }
+    }
+    fclose(fp);
+    return n_overrides;
+}
+
+/* Returns the Link header value for the HTML page `path`, or NULL when there is nothing to preload.
+ * The page is scanned once and rescanned only when its mtime or size changes.
+ * `fp` is left at offset 0. */
+const char *get_preload_links(const char *path, FILE *fp, off_t file_size){
+    preload_override_t *override = find_override(path);
+    if(override){
+        return (override->disabled || !override->links[0]) ? NULL : override->links;
+    }
+
+    struct stat st;
+    if(fstat(fileno(fp), &st) != 0){
+        perror("Cannot stat the file for preload");
+        return NULL;
+    }
+
+    // Cache hit
+    preload_entry_t *entry = NULL;
+    for(unsigned int i = 0; i < n_cache; i++){
+        if(strcmp(preload_cache[i].path, path) == 0){
+            entry = &preload_cache[i];
+            if(entry->mtime == st.st_mtime && entry->size == file_size){
+                return entry->links[0] ? entry->links : NULL;
+            }
+            break; // stale, rescan into the same slot
+        }
+    }
+
+    // Cache miss
+    size_t to_read = file_size < PRELOAD_SCAN_LIMIT ? (size_t)file_size : PRELOAD_SCAN_LIMIT;
+    char *html = malloc(to_read+1);
+    if(!html){
+        perror("preload malloc() error");
+        return NULL;
+    }
+    size_t n_read = fread(html, 1, to_read, fp);
+    html[n_read] = 0;
+    fseeko(fp, 0, SEEK_SET);
+
+    if(!entry){
+        if(n_cache < PRELOAD_CACHE_SIZE){
+            entry = &preload_cache[n_cache++];
+        }else{
+            entry = &preload_cache[next_evict];
+            next_evict = (next_evict + 1) % PRELOAD_CACHE_SIZE;
+        }
+    }
+    snprintf(entry->path, sizeof(entry->path), "%s", path);
+    entry->mtime = st.st_mtime;
+    entry->size = file_size;
+    scan_html(path, html, entry->links, sizeof(entry->links));
+    free(html);
+
+    printf("Preload [%s] : %s\n", path, entry->links[0] ? entry->links : "(none)");
+    return entry->links[0] ? entry->links : NULL;
+}